@@ -17,6 +17,7 @@ SOURCES  := libleaff/fastaFile.C \
             libleaff/merStream.C \
             libleaff/seqCache.C \
             libleaff/seqFactory.C \
+            libleaff/seqFile.C \
             libleaff/seqStore.C \
             libleaff/seqStream.C \
             libleaff/sffFile.C
@@ -8,9 +8,9 @@ ifeq "$(strip ${TARGET_DIR})" ""
 endif
 
 TARGET   := edalign
-SOURCES  := edalign.C
+SOURCES  := edalign.C edalign-NDalign.C
 
-SRC_INCDIRS  := .. ../AS_UTL ../stores ../meryl/libleaff libedlib
+SRC_INCDIRS  := .. ../AS_UTL ../stores ../meryl/libleaff libedlib liboverlap ../utgcns/libNDalign
 
 TGT_LDFLAGS := -L${TARGET_DIR}/lib
 TGT_LDLIBS  := -lleaff -lcanu
@@ -127,15 +127,32 @@ sub estimateMemoryNeededForHaplotypeJobs ($) {
 
     my @haplotypes = getHaplotypes("haplotype");
     my $merSize    = getGlobal("${tag}OvlMerSize");
+    my $merMem     = 0;
+
+    #  splitHaplotype loads the mers for every haplotype at the same time.
 
     foreach my $haplotype (@haplotypes) {
        fetchFile("haplotype/0-mercounts-$haplotype/$haplotype.ms$merSize.only.mcdat");
 
        if (-e "haplotype/0-mercounts-$haplotype/$haplotype.ms$merSize.only.mcdat") {
-          my $size = -s "haplotype/0-mercounts-$haplotype/$haplotype.ms$merSize.only.mcdat";
-          $memEst = int($size / 1073741824.0 + 0.5) * 2;
-        }
-        close(F);
+          $merMem += 2 * -s "haplotype/0-mercounts-$haplotype/$haplotype.ms$merSize.only.mcdat";
+       }
+    }
+
+    #  Reads are classified in batches of 1000 (BATCH_SIZE in splitHaplotype).  Up to four batches
+    #  per thread wait for the workers, four more wait for the writer, and each worker holds one.
+    #  Each read holds its sequence, quality and encoded blob, about three bytes per base.
+
+    my $nReads   = getNumberOfReadsInStore($asm, "hap");
+    my $nBases   = getNumberOfBasesInStore($asm, "hap");
+    my $nThreads = getGlobal("corThreads");
+
+    $nThreads = $1   if ($nThreads =~ m/(\d+)$/);     #  Upper end of a range.
+
+    my $batchMem = ($nReads > 0) ? 9 * $nThreads * 1000 * 3 * $nBases / $nReads : 0;
+
+    if ($merMem > 0) {
+        $memEst = int(($merMem + $batchMem) / 1073741824.0 + 0.5);
     }
 
     if ($memEst == 0) {
@@ -248,51 +265,36 @@ sub haplotypeConfigure ($) {
         print F "\n";
     }
 
-    print F "\n";
-    print F "\$bin/sqStoreDumpFASTQ \\\n";
-    print F "  -S \$seqStore \\\n";
-    print F "  -o ./results/\$jobid.fasta.WORKING \\\n";
-    print F "  -r \$bgn-\$end \\\n";
-    print F "  -fasta -nolibname -noreadname \\\n";
-    print F "  > ./results/\$jobid.err 2>&1 \\\n";
-    print F "&& \\\n";
-    print F "mv ./results/\$jobid.fasta.WORKING.fasta ./results/\$jobid.fasta \\\n";
-    print F "\n";
-
     my @haplotypes = getHaplotypes($base);
     my $merSize    = getGlobal("${tag}OvlMerSize");
-    my $lo         = 0;
-    my $hi         = 1000;
+
+    #  Classify reads directly from the seqStore, using the haplotype-specific
+    #  mers with counts between the thresholds found by estimate-mer-threshold.
+
+    print F "\n";
+    print F "\$bin/splitHaplotype \\\n";
+    print F "  -S \$seqStore \\\n";
+    print F "  -p ./results/\$jobid \\\n";
 
     foreach my $haplotype (@haplotypes) {
        fetchFile("$base/0-mercounts-$haplotype/$haplotype.ms$merSize.threshold");
        open(T, "< haplotype/0-mercounts-$haplotype/$haplotype.ms$merSize.threshold") or caExit("can't open haplotype/0-mercounts-$haplotype/$haplotype.ms$merSize.threshold", undef);
        my $rn = <T>;
        ($rn =~ m/^(\d+)\s+(\d+)$/);
-       $lo = $1;
-       $hi = $2;
+       my $lo = $1;
+       my $hi = $2;
        close(T);
 
-       print F "\$bin/simple-dump \\\n";
-       print F "  -m $merSize \\\n";
-       print F "  -s ../0-mercounts-$haplotype/$haplotype.ms$merSize.only \\\n";
-       print F "  -l $lo -h $hi -f ./results/\$jobid.fasta \\\n";
-       print F "  > ./results/\$jobid.$haplotype.WORKING \\\n";
-       print F "&& \\\n";
-       print F "mv ./results/\$jobid.$haplotype.WORKING ./results/\$jobid.$haplotype \\\n";
-       print F "\n";
+       print F "  -H $haplotype ../0-mercounts-$haplotype/$haplotype.ms$merSize.only $lo $hi \\\n";
     }
-    print F "join results/\$jobid.haplotype* |awk '{print \$1\" \"\$4\" \"\$5\" \"\$8\" \"\$NF}'|awk '{print \$1\" \"\$3/\$2\" \"\$NF/\$(NF-1)}'|awk '{if (\$2 == 0 && \$3 == 0) print \$1\" ambiguous\"; else if (\$2 < \$3) { print \$1\" haplotype2\"; } else if (\$2 > \$3) { print \$1\" haplotype1\"; } else print \$1\" ambiguous\"}'|awk '{print \$NF}'|sort |uniq -c\n";
 
-    # now classify and dump the fasta
-    print F "\$bin/splitHaplotype \\\n";
-    print F "  -S \$seqStore \\\n";
-    print F "  -p results/\$jobid \\\n";
-    print F "  -h " . join(" ", @haplotypes) . "\\\n";
+    print F "  -m $merSize \\\n";
+    print F "  -t " . getGlobal("corThreads") . " \\\n";
     print F "  -cr 1 -cl " . getGlobal("minReadLength") . " \\\n";
     print F "  -b \$bgn -e \$end \\\n";
+    print F "  > ./results/\$jobid.err 2>&1 \\\n";
     print F "&& \\\n";
-    print F "touch ./results/\$jobid.success \\\n";
+    print F "touch ./results/\$jobid.success\n";
     print F "\n";
 
     if (defined($stageDir)) {
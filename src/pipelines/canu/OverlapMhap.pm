@@ -496,6 +496,7 @@ sub mhapConfigure ($$$) {
     print F "     ! -e ./results/\$qry.ovb ] ; then\n";
     print F "  \$bin/mhapConvert \\\n";
     print F "    -S ../../$asm.seqStore \\\n";
+    print F "    -t ", getGlobal("${tag}mhapThreads"), " \\\n";
     print F "    -o ./results/\$qry.mhap.ovb.WORKING \\\n";
     print F "    ./results/\$qry.mhap \\\n";
     print F "  && \\\n";
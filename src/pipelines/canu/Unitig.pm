@@ -262,7 +262,9 @@ sub unitig ($) {
         print F "fi\n";
         print F "\n";
         print F "\n";
-        print F " \$bin/wtdbgConvert -o ./$asm -S ../../$asm.seqStore $asm.ctg.lay \\\n";
+        print F " \$bin/wtdbgConvert -o ./$asm -S ../../$asm.seqStore \\\n";
+        print F "  -t " . getGlobal("dbgThreads") . " \\\n"   if (defined(getGlobal("dbgThreads")));
+        print F "  $asm.ctg.lay \\\n";
         print F "  && \\\n";
         print F "  cp -r ./$asm.ctgStore ../$asm.utgStore \\\n";
         print F "  && \\\n";